@@ -15,25 +15,102 @@
 #include <sys/wait.h>
 #include <signal.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <sys/resource.h>
+#include <dirent.h>
+#include <poll.h>
+#include <limits.h>
 
 /* Constants */
 #define MAX_BUFFER_SIZE 2048  //maximum characters in read buffer
 #define MAX_NUM_OF_ARG 512  //maximum number of arguments to pass to exec..() function
 #define INITIAL_SIZE_OF_BACKGROUND_ARRAY 1000  //initial size of array holding background pids
+#define MAX_NUM_OF_COPROC 16  //maximum number of coprocesses running at once
+#define MAX_COPROC_NAME_SIZE 64  //maximum characters in a coprocess name
+#define MAX_NUM_OF_OUTPUT 16  //maximum number of output redirections for one command
+#define FAN_OUT_PIPE_SIZE 1048576  //requested capacity of pipes used to fan output out to several files
+#define FAN_OUT_BUFFER_SIZE 65536  //buffer size used for output files that do not support splice()
+#define DEFAULT_NUM_OF_BENCH_RUNS 10  //number of timed runs for "bench" when -n is not given
+#define MAX_NUM_OF_BENCH_CMD 16  //maximum number of commands compared by one "bench"
+
+/* A coprocess is a long-lived child connected to the shell by a pair of pipes. The shell writes
+ * requests to its stdin and reads replies from its stdout. */
+struct coprocess
+{
+	char name[MAX_COPROC_NAME_SIZE];  //name given by user; empty string marks an unused entry
+	pid_t pid;  //pid of coprocess (also tracked in backgroundProcesses array); 0 once reaped
+	int toFD;  //write end of pipe to coprocess stdin; -1 once closed
+	int fromFD;  //read end of pipe from coprocess stdout
+	char *fromBuffer;  //output read from the coprocess but not yet printed
+	size_t fromBufferSize;  //allocated size of fromBuffer
+	size_t fromBufferLength;  //number of bytes held in fromBuffer
+};
+
+/* Measurements and summary statistics for one command benchmarked by "bench". Times are in seconds. */
+struct benchResult
+{
+	char command[MAX_BUFFER_SIZE];  //command as typed, for reports
+	int numOfRuns;  //number of timed runs
+	double *wallTimes;  //wall time of each run
+	double *userTimes;  //user CPU time of each run
+	double *systemTimes;  //system CPU time of each run
+	long *maxResidentSizes;  //maximum resident set size of each run, in KB
+	int numOfFailedRuns;  //number of runs that exited with a non-zero exit value
+	double mean, stddev, min, median, p95, p99, max;  //wall time statistics
+	double meanUser, meanSystem;  //mean CPU times
+	int numOfOutliers;  //number of runs outside 1.5 interquartile ranges of the quartiles
+};
 
 /* Function prototypes */
 void setUpSignal();
 void catchSIGTSTP(int signo);
-void reapBackgroundProcesses(int **backgroundProcesses, int *backgroundIndex);
+void catchSIGINT(int signo);
+void reapBackgroundProcesses(int **backgroundProcesses, int *backgroundIndex, struct coprocess *coprocesses);
 void killAllBackgroundProcesses(int **backgroundProcesses, int *backgroundIndex);
 void notifyBgChangeStatus();
 void subInProcessId (char **readBuffer, int shellPid);
 int processInput(int numCharsEntered, char *readBuffer, char **argv, char **inputRedirection,
-					char **outputRedirection, bool *runInBackground, bool *ignoreLine);
+					char **outputRedirection, bool *appendOutput, bool *runInBackground, bool *ignoreLine,
+					bool *ignoredTokens);
 void builtInCd(char **argv);
-void executeCommand(char **argv, char *inputRedirection, char *outputRedirection,
-					bool runInBackground, int *exitMethod, int **backgroundProcesses,
+void builtInCoproc(char **argv, struct coprocess *coprocesses, int **backgroundProcesses,
+					int *backgroundIndex, int *sizeOfBackgroundArray, char **readBuffer);
+void startCoprocess(char **argv, struct coprocess *coprocesses, int **backgroundProcesses,
+					int *backgroundIndex, int *sizeOfBackgroundArray, char **readBuffer);
+void sendToCoprocess(char **argv, struct coprocess *coprocesses);
+void readFromCoprocess(char **argv, struct coprocess *coprocesses);
+int waitForCoprocess(struct coprocess *coproc, int fd, short events);
+struct coprocess *findCoprocess(struct coprocess *coprocesses, char *name);
+void closeCoprocess(struct coprocess *coproc);
+void closeAllCoprocesses(struct coprocess *coprocesses);
+void builtInBench(char **argv, char *inputRedirection, char **outputRedirection, bool *appendOutput,
+					char **readBuffer, int **backgroundProcesses);
+int runBenchmark(struct benchResult *result, char **commandArgv, int numOfRuns, int numOfWarmups,
+					char *inputRedirection, char **outputRedirection, bool *appendOutput,
+					char **readBuffer, int **backgroundProcesses);
+bool parseCount(char *text, int *count);
+double percentile(double *sortedValues, int numOfValues, double p);
+int compareDoubles(const void *a, const void *b);
+void printBenchResult(struct benchResult *result, int numOfWarmups);
+void writeBenchCsv(char *fileName, struct benchResult *results, int numOfCommands);
+void writeBenchJson(char *fileName, struct benchResult *results, int numOfCommands);
+void executeCommand(char **argv, char *inputRedirection, char **outputRedirection,
+					bool *appendOutput, bool runInBackground, int *exitMethod, int **backgroundProcesses,
 					int *backgroundIndex, int *sizeOfBackgroundArray, char **readBuffer, int *exitStatus);
+pid_t spawnCommand(char **argv, char *inputRedirection, char **outputRedirection, bool *appendOutput,
+					bool runInBackground, int spawnErrorFD, char **readBuffer, int **backgroundProcesses);
+void reportSpawnFailure(int spawnErrorFD);
+void addBackgroundProcess(pid_t spawnPid, int **backgroundProcesses, int *backgroundIndex,
+					int *sizeOfBackgroundArray, char **argv, char **readBuffer);
+int openOutputRedirection(char *outputRedirection, bool appendOutput, bool forSplice);
+void fanOutOutput(int *targetFDs, char **outputRedirection, int numOfTargets, char **argv, char **readBuffer,
+					int **backgroundProcesses);
+int fanOutPipe(int sourceFD, int *targetFDs, char **outputRedirection, int numOfTargets);
+void closeOtherDescriptors(int sourceFD, int *targetFDs, int numOfTargets);
+bool isFanOutDescriptor(int fd, int sourceFD, int *targetFDs, int numOfTargets);
+int spliceAll(int sourceFD, int targetFD, size_t length, char *targetName, bool *copying);
 void freeAll(char **argv, char **readBuffer, int **backgroundProcesses);
 
 /* Global variables */
@@ -51,6 +128,10 @@ int main(int argc, char* argv[])
 	int *backgroundProcesses = calloc(sizeOfBackgroundArray, sizeof(int));
 	int backgroundIndex = 0;  //next available array index for adding a background pid
 
+	/* Table of running coprocesses -- their pids are also kept in backgroundProcesses for reaping */
+	struct coprocess coprocesses[MAX_NUM_OF_COPROC];
+	memset(coprocesses, 0, sizeof(coprocesses));
+
 	int exitMethod = 0;  //exit method set by return of child process. 0 = exited normally, 1 = terminated by signal.
 	int exitStatus = 0;  //exit status of child process if exited normally, or signal number if terminated by signal.
 
@@ -61,12 +142,14 @@ int main(int argc, char* argv[])
 		/* Initialize variables to hold user input */
 		char **argv = calloc(MAX_NUM_OF_ARG + 1, sizeof(char *));   //argv to hold arguments; argv[0] will hold command
 		char *inputRedirection = NULL;  //char pointer to input file
-		char *outputRedirection = NULL;  //char pointer to output file
+		char *outputRedirection[MAX_NUM_OF_OUTPUT + 1] = {NULL};  //char pointers to output files, NULL-terminated
+		bool appendOutput[MAX_NUM_OF_OUTPUT] = {false};  //bool flags for appending (">>") to each output file
 		bool runInBackground = false;  //bool flag for running process in background
 		bool ignoreLine = false;  //bool flag for ignoring line if blank or comment line
+		bool ignoredTokens = false;  //bool flag for words dropped after the redirections
 
 		/* Reap any available background processes */
-		reapBackgroundProcesses(&backgroundProcesses, &backgroundIndex);
+		reapBackgroundProcesses(&backgroundProcesses, &backgroundIndex, coprocesses);
 
 		/* Notify user if foreground-only mode has been turned on/off */
 		notifyBgChangeStatus();
@@ -93,14 +176,17 @@ int main(int argc, char* argv[])
 
 		/* Parse input and set runInBackground & ignoreLine bool flags*/
 		int result = processInput(numCharsEntered, readBuffer, argv, &inputRedirection,
-									&outputRedirection, &runInBackground, &ignoreLine);
+									outputRedirection, appendOutput, &runInBackground, &ignoreLine,
+									&ignoredTokens);
 
 		/* If parse input is successful and ignoreLine is false */
 		if(result == 0 && !ignoreLine)
 		{
 			if(strcmp(argv[0], "exit") == 0)  //built-in "exit" command
 			{
-				/* Kill all background processes and clear runShell bool flag to exit while loop. */
+				/* Close coprocess pipes, kill all background processes (coprocesses included),
+				 * and clear runShell bool flag to exit while loop. */
+				closeAllCoprocesses(coprocesses);
 				killAllBackgroundProcesses(&backgroundProcesses, &backgroundIndex);
 				runShell = false;
 			}
@@ -108,6 +194,35 @@ int main(int argc, char* argv[])
 			{
 				builtInCd(argv);  //pass arguments to builtInCd() function to deal with directory change
 			}
+			else if (strcmp(argv[0], "coproc") == 0)  //built-in "coproc" command
+			{
+				/* Redirections and a trailing "&" have been cut out of argv, which would silently
+				 * shorten a request sent to a coprocess, so reject the line instead. */
+				if(inputRedirection != NULL || outputRedirection[0] != NULL || runInBackground)
+				{
+					fprintf(stderr, "coproc: <, >, >> and & are not supported\n");
+					fflush(stderr);
+				}
+				else
+				{
+					builtInCoproc(argv, coprocesses, &backgroundProcesses, &backgroundIndex,
+						&sizeOfBackgroundArray, &readBuffer);
+				}
+			}
+			else if (strcmp(argv[0], "bench") == 0)  //built-in "bench" command
+			{
+				/* Words after the redirections would be dropped, e.g. a "::" and the commands after it. */
+				if(ignoredTokens)
+				{
+					fprintf(stderr, "bench: redirections must come after the last command\n");
+					fflush(stderr);
+				}
+				else
+				{
+					builtInBench(argv, inputRedirection, outputRedirection, appendOutput, &readBuffer,
+						&backgroundProcesses);
+				}
+			}
 			else if (strcmp(argv[0], "status") == 0)  //built in "status" command
 			{
 				if(exitMethod == 0)  //if child process exited normally, display exit status
@@ -123,7 +238,7 @@ int main(int argc, char* argv[])
 			}
 			else  //else a unix command, call executeCommand() to set up and execute execvp() call
 			{
-				executeCommand(argv, inputRedirection, outputRedirection, runInBackground, &exitMethod,
+				executeCommand(argv, inputRedirection, outputRedirection, appendOutput, runInBackground, &exitMethod,
 					&backgroundProcesses, &backgroundIndex, &sizeOfBackgroundArray, &readBuffer, &exitStatus);
 			}
 		}
@@ -144,7 +259,8 @@ int main(int argc, char* argv[])
 
 /*
  * Setup signal handlers to parent process (the shell). SIGINT (Ctrl-C) is ignored by parent shell.
- * SIGTSTP (Ctrl-Z) toggles foreground-only mode in parent shell.
+ * SIGTSTP (Ctrl-Z) toggles foreground-only mode in parent shell. SIGPIPE is ignored so writing to
+ * a coprocess that has exited returns an error instead of killing the shell.
  */
 void setUpSignal()
 {
@@ -164,6 +280,7 @@ void setUpSignal()
 	/* Register the struct sigaction with the parent shell */
 	sigaction(SIGINT, &SIGINT_action, NULL);
 	sigaction(SIGTSTP, &SIGTSTP_action, NULL);
+	sigaction(SIGPIPE, &SIGINT_action, NULL);  //SIGPIPE is ignored the same way as SIGINT
 }
 
 /*
@@ -184,12 +301,20 @@ void catchSIGTSTP(int signo)
 	}
 }
 
+/*
+ * Invoked when the shell catches a SIGINT while waiting for a coprocess. Does nothing; receiving the
+ * signal interrupts the wait.
+ */
+void catchSIGINT(int signo)
+{
+}
+
 /*
  * Reap background child processes. Goes through an array of pids and checks if the process
  * has terminated. If not, continue on to next pid; or if so, print exit status and remove
- * pid from array.
+ * pid from array. If the process was a coprocess, its entry is marked as exited.
  */
-void reapBackgroundProcesses(int **backgroundProcesses, int *backgroundIndex)
+void reapBackgroundProcesses(int **backgroundProcesses, int *backgroundIndex, struct coprocess *coprocesses)
 {
 	pid_t reapedPid;
 	int childExitMethod;
@@ -223,6 +348,17 @@ void reapBackgroundProcesses(int **backgroundProcesses, int *backgroundIndex)
 				fflush(stdout);
 			}
 
+			/* Mark the coprocess entry, if any, that belongs to the finished process as exited. The entry
+			 * and its pipes are kept so output not yet read is not lost; readFromCoprocess() releases it
+			 * at end-of-file. */
+			for(int j = 0; j < MAX_NUM_OF_COPROC; j++)
+			{
+				if(coprocesses[j].name[0] != '\0' && coprocesses[j].pid == reapedPid)
+				{
+					coprocesses[j].pid = 0;
+				}
+			}
+
 			/* Remove pid from array by left-shifting array contents 1 element towards beginning. */
 			for(int j = i; j < *backgroundIndex - 1; j++)
 			{
@@ -324,10 +460,13 @@ void subInProcessId (char **readBuffer, int shellPid)
 
 /*
  * Parse input received from the user. Place the command and arguments into argv. Optionally, set the inputRedirection
- * and outputRedirection char pointers, runInBackground bool flag, and ignoreLine bool flag.
+ * char pointer, fill the outputRedirection and appendOutput arrays, and set the runInBackground bool flag and
+ * ignoreLine bool flag. The ignoredTokens bool flag is set if words after the redirections (other than a
+ * final "&") were dropped.
  */
 int processInput(int numCharsEntered, char *readBuffer, char **argv, char **inputRedirection,
-					char **outputRedirection, bool *runInBackground, bool *ignoreLine)
+					char **outputRedirection, bool *appendOutput, bool *runInBackground, bool *ignoreLine,
+					bool *ignoredTokens)
 {
 	/* Setup string tokenizer function to delimit on space and newline character. */
 	char delim[] = " \n";
@@ -356,8 +495,8 @@ int processInput(int numCharsEntered, char *readBuffer, char **argv, char **inpu
 
 			if(token != NULL)
 			{
-				/* If token read is "<" or ">", break loop so next loop can handle redirection. */
-				if(strcmp(token, "<") == 0 || strcmp(token, ">") == 0)
+				/* If token read is "<", ">" or ">>", break loop so next loop can handle redirection. */
+				if(strcmp(token, "<") == 0 || strcmp(token, ">") == 0 || strcmp(token, ">>") == 0)
 				{
 					break;
 				}
@@ -405,6 +544,7 @@ int processInput(int numCharsEntered, char *readBuffer, char **argv, char **inpu
 		} while(token != NULL);
 
 		/* Get I/O redirection. */
+		int numOfOutput = 0;  //output redirection counter
 		while(token != NULL)
 		{
 			/* If input redirection is specified, assign inputRedirection char pointer
@@ -423,10 +563,11 @@ int processInput(int numCharsEntered, char *readBuffer, char **argv, char **inpu
 
 				*inputRedirection = token;  //do inputRedirection char pointer assignment
 			}
-			/* If output redirection is specified, assign outputRedirection char pointer
-			 * to point to name of file. */
-			else if(strcmp(token, ">") == 0)
+			/* If output redirection is specified, add the name of file to the outputRedirection
+			 * array. ">>" appends to the file instead of truncating it. */
+			else if(strcmp(token, ">") == 0 || strcmp(token, ">>") == 0)
 			{
+				bool append = (strcmp(token, ">>") == 0);
 				token = strtok(NULL, delim);  //get output file name
 
 				/* Print error if no output file provided and return from function. */
@@ -437,9 +578,19 @@ int processInput(int numCharsEntered, char *readBuffer, char **argv, char **inpu
 					return 1;
 				}
 
-				*outputRedirection = token;  //do outputRedirection char pointer assignment
+				/* Print error if there are more output files than the array can hold and return from function. */
+				if(numOfOutput == MAX_NUM_OF_OUTPUT)
+				{
+					fprintf(stderr, "Too many output redirections!\n");
+					fflush(stderr);
+					return 1;
+				}
+
+				outputRedirection[numOfOutput] = token;  //add output file to outputRedirection array
+				appendOutput[numOfOutput] = append;
+				numOfOutput++;
 			}
-			else  //any other token besides "<" or ">" will cause the while loop to break
+			else  //any other token besides "<", ">" or ">>" will cause the while loop to break
 			{
 				break;
 			}
@@ -451,16 +602,21 @@ int processInput(int numCharsEntered, char *readBuffer, char **argv, char **inpu
 		 * bool if the last word entered is an "&". If the runInBackground bool flag has already
 		 * been previously set in the construction of argv, then this block has no effect. */
 		previousToken = NULL;
+		int numOfIgnored = 0;  //words after the redirections
 		while(token != NULL)
 		{
 			previousToken = token;
 			token = strtok(NULL, delim);
+			numOfIgnored++;
 		}
 
 		if(token == NULL && previousToken != NULL && strcmp(previousToken, "&") == 0)
 		{
 			*runInBackground = true;
+			numOfIgnored--;  //the final "&" is not ignored
 		}
+
+		*ignoredTokens = (numOfIgnored > 0);
 	}
 
 	return 0;
@@ -509,143 +665,196 @@ void builtInCd(char **argv)
 }
 
 /*
- * Execute the command requested by user. Fork off new child, perform any necessary redirection,
- * and call execvp() function. If run in background is requested, then command line control is
- * given directly back to user; otherwise, the process will run in foreground and shell will wait
- * until process finishes execution before returning commmand line control to user.
+ * The shell built-in "coproc" command. Dispatches to the subcommands:
+ *   coproc                   list running coprocesses
+ *   coproc name cmd ...      start cmd as a coprocess called name
+ *   coproc send name ...     write the remaining words, followed by a newline, to the coprocess stdin
+ *   coproc read name         read one line from the coprocess stdout and print it
+ *   coproc close name        close the coprocess stdin so it sees end-of-file; releases an exited coprocess
+ * "send", "read" and "close" are reserved and cannot be used as coprocess names.
  */
-void executeCommand(char **argv, char *inputRedirection, char *outputRedirection, bool runInBackground,
-					int *exitMethod, int **backgroundProcesses, int *backgroundIndex, 
-					int *sizeOfBackgroundArray, char **readBuffer, int *exitStatus)
+void builtInCoproc(char **argv, struct coprocess *coprocesses, int **backgroundProcesses,
+					int *backgroundIndex, int *sizeOfBackgroundArray, char **readBuffer)
 {
-	pid_t spawnPid;
-	int childExitMethod;
-
-	spawnPid = fork();  //fork new child
-
-	if(spawnPid == -1)  //if fork() fails
+	/* With no arguments, list the running coprocesses. */
+	if(argv[1] == NULL)
 	{
-		perror("Bad spawn");
+		for(int i = 0; i < MAX_NUM_OF_COPROC; i++)
+		{
+			if(coprocesses[i].name[0] != '\0' && coprocesses[i].pid != 0)
+			{
+				printf("%s pid %d\n", coprocesses[i].name, coprocesses[i].pid);
+				fflush(stdout);
+			}
+			else if(coprocesses[i].name[0] != '\0')  //exited, but output may remain to be read
+			{
+				printf("%s done\n", coprocesses[i].name);
+				fflush(stdout);
+			}
+		}
+	}
+	else if(strcmp(argv[1], "send") == 0)
+	{
+		sendToCoprocess(argv, coprocesses);
+	}
+	/* "read" and "close" take exactly one name, so more arguments mean an attempt to start a
+	 * coprocess under a reserved name. */
+	else if((strcmp(argv[1], "read") == 0 || strcmp(argv[1], "close") == 0) && argv[2] != NULL
+			&& argv[3] != NULL)
+	{
+		fprintf(stderr, "coproc: %s is a reserved name\n", argv[1]);
 		fflush(stderr);
 	}
-	else if(spawnPid == 0)  //in child process
+	else if(strcmp(argv[1], "read") == 0)
 	{
-		/* If process will run in background but inputRedirection is not assigned, then
-		 * assign "/dev/null" to inputRedirection. */
-		if(runInBackground && inputRedirection == NULL)
+		readFromCoprocess(argv, coprocesses);
+	}
+	else if(strcmp(argv[1], "close") == 0)
+	{
+		struct coprocess *coproc = (argv[2] == NULL) ? NULL : findCoprocess(coprocesses, argv[2]);
+
+		if(coproc == NULL)
 		{
-			inputRedirection = "/dev/null";
+			fprintf(stderr, "coproc: no such coprocess\n");
+			fflush(stderr);
 		}
-
-		/* If process will run in background but outputRedirection is not assigned, then
-		 * assign "/dev/null" to outRedirection. */
-		if(runInBackground && outputRedirection == NULL)
+		else if(coproc->pid == 0)  //already exited: release the entry
 		{
-			outputRedirection = "/dev/null";
+			closeCoprocess(coproc);
 		}
-
-		/* If inputRedirection is assigned something, then open up the file pointed by
-		 * inputRedirection and use dup2() to assign stdin to point to the file. */
-		if(inputRedirection != NULL)
+		else if(coproc->toFD != -1)
 		{
-			int sourceFD;  //will hold file descriptor for opened file
-			sourceFD = open(inputRedirection, O_RDONLY);  //open file for read-only
+			close(coproc->toFD);  //coprocess will read end-of-file; its output can still be read
+			coproc->toFD = -1;
+		}
+	}
+	else
+	{
+		startCoprocess(argv, coprocesses, backgroundProcesses, backgroundIndex, sizeOfBackgroundArray,
+			readBuffer);
+	}
+}
 
-			if(sourceFD == -1)  //if error opening file, print message, free mem, and exit
-			{
-				fprintf(stderr, "cannot open %s for input\n", inputRedirection);
-				fflush(stderr);
+/*
+ * Start argv[2] as a coprocess named argv[1]. Two pipes are created: one connected to the child's stdin
+ * and one connected to its stdout. The shell's ends are opened close-on-exec so later children do not
+ * inherit them (which would keep the coprocess from ever seeing end-of-file). The pid is added to the
+ * backgroundProcesses array so the coprocess is reaped and killed on exit like any background process.
+ */
+void startCoprocess(char **argv, struct coprocess *coprocesses, int **backgroundProcesses,
+					int *backgroundIndex, int *sizeOfBackgroundArray, char **readBuffer)
+{
+	char *name = argv[1];
 
-				freeAll(argv, readBuffer, backgroundProcesses);  //needed to prevent mem leaks
-				exit(1);
-			}
+	if(argv[2] == NULL)  //print error if no command provided
+	{
+		fprintf(stderr, "coproc: no command specified for %s\n", name);
+		fflush(stderr);
+		return;
+	}
 
-			int result = dup2(sourceFD, 0);  //assign stdin to point to sourceFD
-			if(result == -1)  //if error in dup() operation, print message, free mem, and exit
-			{
-				perror("Source dup2() error");
-				fflush(stderr);
+	if(strlen(name) >= MAX_COPROC_NAME_SIZE)
+	{
+		fprintf(stderr, "coproc: name %s is too long\n", name);
+		fflush(stderr);
+		return;
+	}
 
-				freeAll(argv, readBuffer, backgroundProcesses);  //needed to prevent mem leaks
-				exit(1);
-			}
-		}
+	if(strcmp(name, "send") == 0 || strcmp(name, "read") == 0 || strcmp(name, "close") == 0)
+	{
+		fprintf(stderr, "coproc: %s is a reserved name\n", name);
+		fflush(stderr);
+		return;
+	}
+
+	if(findCoprocess(coprocesses, name) != NULL)
+	{
+		fprintf(stderr, "coproc: %s already exists\n", name);
+		fflush(stderr);
+		return;
+	}
 
-		/* If outputRedirection is assigned something, then open up the file pointed by
-		 * outputRedirection and use dup2() to assign stdout to point to the file. */
-		if(outputRedirection != NULL)
+	/* Find an unused entry in the coprocess table. */
+	struct coprocess *coproc = NULL;
+	for(int i = 0; i < MAX_NUM_OF_COPROC && coproc == NULL; i++)
+	{
+		if(coprocesses[i].name[0] == '\0')
 		{
-			int targetFD;  //will hold file descriptor for opened file
+			coproc = &coprocesses[i];
+		}
+	}
 
-			/* If opening "/dev/null", then open for write-only. Otherwise, in addition
-			 * to opening file for write-only, if non-existent, then create the file, and
-			 * if file already exist, truncate the file. */
-			if(strcmp(outputRedirection, "/dev/null") == 0)
-			{
-				targetFD = open("/dev/null", O_WRONLY);
-			}
-			else
-			{
-				/* Opened file permission set to 644: user(RW-), group(R--), and others(R--). */
-				targetFD = open(outputRedirection, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-			}
+	if(coproc == NULL)
+	{
+		fprintf(stderr, "coproc: too many coprocesses\n");
+		fflush(stderr);
+		return;
+	}
 
-			if(targetFD == -1)  //if error opening file, print message, free mem, and exit
-			{
-				fprintf(stderr, "cannot open %s for output\n", outputRedirection);
-				fflush(stderr);
+	int toPipe[2];  //shell writes to toPipe[1], coprocess reads from toPipe[0]
+	int fromPipe[2];  //coprocess writes to fromPipe[1], shell reads from fromPipe[0]
 
-				freeAll(argv, readBuffer, backgroundProcesses);  //needed to prevent mem leaks
-				exit(1);
-			}
+	if(pipe2(toPipe, O_CLOEXEC) == -1)
+	{
+		perror("coproc: pipe error");
+		fflush(stderr);
+		return;
+	}
 
-			int result = dup2(targetFD, 1);  //assign stdout to point to targetFD
-			if(result == -1)  //if error in dup() operation, print message, free mem, and exit
-			{
-				perror("Target dup2() error");
-				fflush(stderr);
+	if(pipe2(fromPipe, O_CLOEXEC) == -1)
+	{
+		perror("coproc: pipe error");
+		fflush(stderr);
+		close(toPipe[0]);
+		close(toPipe[1]);
+		return;
+	}
 
-				freeAll(argv, readBuffer, backgroundProcesses);  //needed to prevent mem leaks
-				exit(1);
-			}
+	pid_t spawnPid = fork();  //fork new child
+
+	if(spawnPid == -1)  //if fork() fails
+	{
+		perror("Bad spawn");
+		fflush(stderr);
+		close(toPipe[0]);
+		close(toPipe[1]);
+		close(fromPipe[0]);
+		close(fromPipe[1]);
+	}
+	else if(spawnPid == 0)  //in child process
+	{
+		/* Connect stdin and stdout to the pipes. The descriptors made by dup2() do not carry
+		 * close-on-exec, while all the originals are closed by execvp(). */
+		if(dup2(toPipe[0], 0) == -1 || dup2(fromPipe[1], 1) == -1)
+		{
+			perror("Coprocess dup2() error");
+			fflush(stderr);
+
+			freeAll(argv, readBuffer, backgroundProcesses);  //needed to prevent mem leaks
+			exit(1);
 		}
 
-		/* Create signal handlers for child process */
+		/* A coprocess runs in the background: ignore SIGINT and SIGTSTP, restore default SIGPIPE. */
 		struct sigaction ignore_action = {{0}};
 		struct sigaction default_action = {{0}};
 
-		/* Struct sigaction to ignore signal */
 		ignore_action.sa_handler = SIG_IGN;
 		sigfillset(&ignore_action.sa_mask);
 		ignore_action.sa_flags = 0;
 
-		/* Struct sigaction to take default action */
 		default_action.sa_handler = SIG_DFL;
 		sigfillset(&default_action.sa_mask);
 		default_action.sa_flags = 0;
 
-		/* Register child processes to ignore SIGTSTP */
+		sigaction(SIGINT, &ignore_action, NULL);
 		sigaction(SIGTSTP, &ignore_action, NULL);
+		sigaction(SIGPIPE, &default_action, NULL);
 
-		/* If child process is to run in background (i.e. runInBackground flag is set
-		 * AND bgOn flag is set to enable background processes), then register the
-		 * child process to ignore the SIGINT. */
-		if(runInBackground && bgOn)
-		{
-			sigaction(SIGINT, &ignore_action, NULL);
-		}
-		/* Else, child will run in foreground. Register child process
-		 * to take default action on receipt of SIGINT. */
-		else
-		{
-			sigaction(SIGINT, &default_action, NULL);
-		}
-
-		/* Execute the command in argv[0] and pass argv. */
-		execvp(argv[0], argv);
+		/* Execute the command in argv[2] and pass the remaining arguments. */
+		execvp(argv[2], argv + 2);
 
 		/* The following section will only execute if execvp returns an error. */
-		fprintf(stderr, "%s: no such file or directory\n", argv[0]);
+		fprintf(stderr, "%s: no such file or directory\n", argv[2]);
 		fflush(stderr);
 
 		freeAll(argv, readBuffer, backgroundProcesses);  //needed to prevent mem leaks
@@ -653,59 +862,1406 @@ void executeCommand(char **argv, char *inputRedirection, char *outputRedirection
 	}
 	else  //in parent process
 	{
-		/* If child process is running in foregrond (i.e. runInBackground flag is not set, or
-		 * bgOn is not set, that is, foreground-only mode is ON), then wait for process
-		 * to terminated. Determine if the child exited normarlly or was terminated by signal
-		 * and extract and save the exit status. Print out message if child process was terminated
-		 * by a signal. */
-		if(!runInBackground || !bgOn)
+		/* Close the child's ends and keep the shell's ends in the coprocess table. */
+		close(toPipe[0]);
+		close(fromPipe[1]);
+
+		/* Either way the child is added to the backgroundProcesses array so it is reaped. */
+		addBackgroundProcess(spawnPid, backgroundProcesses, backgroundIndex, sizeOfBackgroundArray,
+			argv, readBuffer);
+
+		char *fromBuffer = malloc(MAX_BUFFER_SIZE);
+
+		if(fromBuffer == NULL)  //the coprocess cannot be read from: stop it and give up
 		{
-			/* Wait until child process has finished -- while loop is necessary if waitpid()
-			 * is interrupted by TSTP signal. */
-			int receivedPid = 0;
-			while((receivedPid = waitpid(spawnPid, &childExitMethod, 0)) != spawnPid);
+			perror("coproc: buffer error");
+			fflush(stderr);
+			close(toPipe[1]);
+			close(fromPipe[0]);
+			kill(spawnPid, SIGTERM);
+			return;
+		}
 
-			if(WIFEXITED(childExitMethod) != 0)  //child exited normally
-			{
-				*exitStatus = WEXITSTATUS(childExitMethod);  //extract exit status
-				*exitMethod = 0;  //set exitMethod to 0, indicating normal exit
-			}
-			else if(WIFSIGNALED(childExitMethod) != 0)  //child terminated by signal
-			{
-				*exitStatus = WTERMSIG(childExitMethod);  //extract signal that terminated process
-				*exitMethod = 1;  //set exitMethod to 1, indicating terminated by signal
+		/* Writes must not block so sendToCoprocess() can wait in poll() for room in the pipe instead. */
+		fcntl(toPipe[1], F_SETFL, O_NONBLOCK);
 
-				printf("terminated by signal %d\n", *exitStatus);
-				fflush(stdout);
-			}
+		strcpy(coproc->name, name);
+		coproc->pid = spawnPid;
+		coproc->toFD = toPipe[1];
+		coproc->fromFD = fromPipe[0];
+		coproc->fromBuffer = fromBuffer;
+		coproc->fromBufferSize = MAX_BUFFER_SIZE;
+		coproc->fromBufferLength = 0;
+
+		printf("coprocess %s pid is %d\n", name, spawnPid);
+		fflush(stdout);
+	}
+}
+
+/*
+ * Write argv[3] onwards, separated by spaces and terminated by a newline, to the stdin of the
+ * coprocess named argv[2]. The line is no longer than PIPE_BUF, so it is written whole by a single
+ * write() once the pipe has room. If the coprocess stops reading, the wait can be aborted with
+ * Ctrl-C or Ctrl-Z.
+ */
+void sendToCoprocess(char **argv, struct coprocess *coprocesses)
+{
+	struct coprocess *coproc = (argv[2] == NULL) ? NULL : findCoprocess(coprocesses, argv[2]);
+
+	if(coproc == NULL)
+	{
+		fprintf(stderr, "coproc: no such coprocess\n");
+		fflush(stderr);
+		return;
+	}
+
+	if(coproc->toFD == -1)
+	{
+		fprintf(stderr, "coproc: input to %s is closed\n", coproc->name);
+		fflush(stderr);
+		return;
+	}
+
+	/* Build the line to send. Input is limited to MAX_BUFFER_SIZE, so the line always fits. */
+	char line[MAX_BUFFER_SIZE + 1];
+	memset(line, '\0', sizeof(line));
+	size_t lineLength = 0;
+
+	for(int i = 3; argv[i] != NULL; i++)
+	{
+		if(i > 3)
+		{
+			line[lineLength++] = ' ';
 		}
-		/* Else, child process is running in background. Print child pid to screen and add
-		 * pid to backgroundProcesses array.  */
-		else
+
+		size_t argLength = strlen(argv[i]);
+		memcpy(line + lineLength, argv[i], argLength);
+		lineLength += argLength;
+	}
+
+	line[lineLength++] = '\n';
+
+	/* Write the line, waiting for room in the pipe while it is full. */
+	while(write(coproc->toFD, line, lineLength) == -1)
+	{
+		if(errno != EAGAIN)
 		{
-			printf("background pid is %d\n", spawnPid);
-			fflush(stdout);
+			perror("coproc: write error");
+			fflush(stderr);
+			return;
+		}
 
-			/* If backgroundProcesses is at capacity, double the allocated memory size. */
-			if(*backgroundIndex == *sizeOfBackgroundArray)
-			{
-				(*sizeOfBackgroundArray) *= 2;  //double array size
-				*backgroundProcesses = realloc(*backgroundProcesses, *sizeOfBackgroundArray * sizeof(int));
+		if(waitForCoprocess(coproc, coproc->toFD, POLLOUT) == -1)
+		{
+			return;
+		}
+	}
+}
 
-				if(*backgroundProcesses == NULL)  //display message if error encountered in realloc
-				{
-					perror("Error in expanding background array\n");
-					fflush(stderr);
+/*
+ * Read one line from the stdout of the coprocess named argv[2] and print it. Waits until the coprocess
+ * writes a complete line, so the coprocess must flush its output after each reply; the wait can be
+ * aborted with Ctrl-C or Ctrl-Z. Output read beyond the line is kept for the next read. Once the
+ * output of an exited coprocess has been read to end-of-file, its entry is released.
+ */
+void readFromCoprocess(char **argv, struct coprocess *coprocesses)
+{
+	struct coprocess *coproc = (argv[2] == NULL) ? NULL : findCoprocess(coprocesses, argv[2]);
 
-					freeAll(argv, readBuffer, backgroundProcesses);
-					exit(1);
-				}
+	if(coproc == NULL)
+	{
+		fprintf(stderr, "coproc: no such coprocess\n");
+		fflush(stderr);
+		return;
+	}
+
+	char *newline;
+	while((newline = memchr(coproc->fromBuffer, '\n', coproc->fromBufferLength)) == NULL)
+	{
+		/* No complete line yet. Make room if the buffer is full, then wait for more output. */
+		if(coproc->fromBufferLength == coproc->fromBufferSize)
+		{
+			char *largerBuffer = realloc(coproc->fromBuffer, coproc->fromBufferSize * 2);
+
+			if(largerBuffer == NULL)
+			{
+				perror("coproc: buffer error");
+				fflush(stderr);
+				return;
 			}
 
-			(*backgroundProcesses)[*backgroundIndex] = spawnPid;  //add child pid to backgroundProcesses array
-			(*backgroundIndex)++;  //increment backgroundIndex
+			coproc->fromBuffer = largerBuffer;
+			coproc->fromBufferSize *= 2;
 		}
-	}
+
+		if(waitForCoprocess(coproc, coproc->fromFD, POLLIN) == -1)
+		{
+			return;
+		}
+
+		ssize_t numCharsRead = read(coproc->fromFD, coproc->fromBuffer + coproc->fromBufferLength,
+									coproc->fromBufferSize - coproc->fromBufferLength);
+
+		if(numCharsRead == -1)
+		{
+			perror("coproc: read error");
+			fflush(stderr);
+			return;
+		}
+		else if(numCharsRead == 0)  //end-of-file
+		{
+			if(coproc->fromBufferLength > 0)  //print a last line that has no newline
+			{
+				printf("%.*s\n", (int)coproc->fromBufferLength, coproc->fromBuffer);
+				fflush(stdout);
+				coproc->fromBufferLength = 0;
+			}
+			else
+			{
+				fprintf(stderr, "coproc: no output from %s\n", coproc->name);
+				fflush(stderr);
+
+				if(coproc->pid == 0)  //exited and drained: release the entry
+				{
+					closeCoprocess(coproc);
+				}
+			}
+			return;
+		}
+
+		coproc->fromBufferLength += numCharsRead;
+	}
+
+	/* Print the line and keep whatever follows it. */
+	size_t lineLength = newline - coproc->fromBuffer;
+	printf("%.*s\n", (int)lineLength, coproc->fromBuffer);
+	fflush(stdout);
+
+	coproc->fromBufferLength -= lineLength + 1;
+	memmove(coproc->fromBuffer, newline + 1, coproc->fromBufferLength);
+}
+
+/*
+ * Wait until fd, one of the coprocess's pipes, is ready for events (POLLIN or POLLOUT). SIGINT, which
+ * the shell otherwise ignores, is caught for the duration of the wait, so either Ctrl-C or Ctrl-Z
+ * (SIGTSTP) aborts it. Returns 0 when ready, or -1 after printing a message if interrupted.
+ */
+int waitForCoprocess(struct coprocess *coproc, int fd, short events)
+{
+	struct sigaction SIGINT_action = {{0}};
+	struct sigaction oldSIGINT_action;
+	sigset_t blockSet;
+	sigset_t oldSet;
+	sigset_t waitSet;
+
+	/* Block SIGINT until ppoll() atomically unblocks it, so a Ctrl-C cannot slip in before the wait. */
+	sigemptyset(&blockSet);
+	sigaddset(&blockSet, SIGINT);
+	sigprocmask(SIG_BLOCK, &blockSet, &oldSet);
+
+	SIGINT_action.sa_handler = catchSIGINT;
+	sigfillset(&SIGINT_action.sa_mask);
+	SIGINT_action.sa_flags = 0;
+	sigaction(SIGINT, &SIGINT_action, &oldSIGINT_action);
+
+	waitSet = oldSet;
+	sigdelset(&waitSet, SIGINT);
+
+	struct pollfd pollFD = {fd, events, 0};
+	int result = ppoll(&pollFD, 1, NULL, &waitSet);
+	int pollErrno = errno;
+
+	/* Go back to ignoring SIGINT; a SIGINT still pending is discarded. */
+	sigaction(SIGINT, &oldSIGINT_action, NULL);
+	sigprocmask(SIG_SETMASK, &oldSet, NULL);
+
+	if(result == -1)
+	{
+		if(pollErrno == EINTR)
+		{
+			fprintf(stderr, "\ncoproc: interrupted while waiting for %s\n", coproc->name);
+		}
+		else
+		{
+			errno = pollErrno;
+			perror("coproc: poll error");
+		}
+		fflush(stderr);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Return the coprocess with the given name, or NULL if there is none. The coprocess may have exited.
+ */
+struct coprocess *findCoprocess(struct coprocess *coprocesses, char *name)
+{
+	for(int i = 0; i < MAX_NUM_OF_COPROC; i++)
+	{
+		if(coprocesses[i].name[0] != '\0' && strcmp(coprocesses[i].name, name) == 0)
+		{
+			return &coprocesses[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Close the shell's ends of a coprocess's pipes and mark its table entry unused. If the coprocess is
+ * still running, its pid stays in the backgroundProcesses array until it is reaped.
+ */
+void closeCoprocess(struct coprocess *coproc)
+{
+	if(coproc->toFD != -1)
+	{
+		close(coproc->toFD);
+	}
+
+	close(coproc->fromFD);
+	free(coproc->fromBuffer);
+
+	memset(coproc, 0, sizeof(struct coprocess));
+}
+
+/*
+ * Close the pipes of every running coprocess. Used on exit so coprocesses see end-of-file.
+ */
+void closeAllCoprocesses(struct coprocess *coprocesses)
+{
+	for(int i = 0; i < MAX_NUM_OF_COPROC; i++)
+	{
+		if(coprocesses[i].name[0] != '\0')
+		{
+			closeCoprocess(&coprocesses[i]);
+		}
+	}
+}
+
+/*
+ * The shell built-in "bench" command: bench [-n runs] [-w warmups] [-c file] [-j file] cmd ... [:: cmd ...]
+ * Runs each command (separated by "::") runs times after warmups untimed runs, and prints summary
+ * statistics of the wall times. -c and -j also write the results to a CSV or JSON file. Commands read
+ * from and write to "/dev/null" unless redirected on the bench line.
+ */
+void builtInBench(char **argv, char *inputRedirection, char **outputRedirection, bool *appendOutput,
+					char **readBuffer, int **backgroundProcesses)
+{
+	int numOfRuns = DEFAULT_NUM_OF_BENCH_RUNS;
+	int numOfWarmups = 0;
+	char *csvFile = NULL;
+	char *jsonFile = NULL;
+
+	/* Parse options. Each option takes the next argument as its value. An unknown option, or one
+	 * without a value, is an error. */
+	int i = 1;
+	bool validOptions = true;
+	while(argv[i] != NULL && argv[i][0] == '-' && validOptions)
+	{
+		if(argv[i + 1] == NULL)
+		{
+			validOptions = false;
+			break;
+		}
+		else if(strcmp(argv[i], "-n") == 0)
+		{
+			validOptions = parseCount(argv[i + 1], &numOfRuns);
+		}
+		else if(strcmp(argv[i], "-w") == 0)
+		{
+			validOptions = parseCount(argv[i + 1], &numOfWarmups);
+		}
+		else if(strcmp(argv[i], "-c") == 0)
+		{
+			csvFile = argv[i + 1];
+		}
+		else if(strcmp(argv[i], "-j") == 0)
+		{
+			jsonFile = argv[i + 1];
+		}
+		else
+		{
+			validOptions = false;
+			break;
+		}
+		i += 2;
+	}
+
+	if(!validOptions || argv[i] == NULL || numOfRuns < 1)
+	{
+		fprintf(stderr, "usage: bench [-n runs] [-w warmups] [-c file] [-j file] cmd ... [:: cmd ...]\n");
+		fflush(stderr);
+		return;
+	}
+
+	/* Commands read from and write to "/dev/null" unless redirected, so the terminal is not timed. */
+	char *nullOutput[2] = {"/dev/null", NULL};
+	bool nullAppend[1] = {false};
+	if(inputRedirection == NULL)
+	{
+		inputRedirection = "/dev/null";
+	}
+	if(outputRedirection[0] == NULL)
+	{
+		outputRedirection = nullOutput;
+		appendOutput = nullAppend;
+	}
+
+	/* Split the remaining arguments into commands at each "::" and benchmark them one at a time. */
+	struct benchResult results[MAX_NUM_OF_BENCH_CMD];
+	memset(results, 0, sizeof(results));
+	int numOfCommands = 0;
+	bool failed = false;
+
+	while(argv[i] != NULL && !failed)
+	{
+		if(numOfCommands == MAX_NUM_OF_BENCH_CMD)
+		{
+			fprintf(stderr, "bench: too many commands\n");
+			fflush(stderr);
+			failed = true;
+			break;
+		}
+
+		/* Copy the command into its own argv, NULL-terminated for execvp(). */
+		char **commandArgv = calloc(MAX_NUM_OF_ARG + 1, sizeof(char *));
+		if(commandArgv == NULL)
+		{
+			perror("bench");
+			fflush(stderr);
+			failed = true;
+			break;
+		}
+
+		int numOfArg = 0;
+		for(; argv[i] != NULL && strcmp(argv[i], "::") != 0; i++)
+		{
+			commandArgv[numOfArg++] = argv[i];
+		}
+
+		if(argv[i] != NULL)  //skip the "::"
+		{
+			i++;
+		}
+
+		if(numOfArg == 0)
+		{
+			fprintf(stderr, "bench: empty command\n");
+			fflush(stderr);
+			failed = true;
+		}
+		else if(runBenchmark(&results[numOfCommands], commandArgv, numOfRuns, numOfWarmups, inputRedirection,
+					outputRedirection, appendOutput, readBuffer, backgroundProcesses) == -1)
+		{
+			failed = true;
+		}
+		else
+		{
+			printBenchResult(&results[numOfCommands], numOfWarmups);
+		}
+
+		numOfCommands++;
+		free(commandArgv);
+	}
+
+	if(!failed)
+	{
+		/* Compare every command against the one with the smallest median. */
+		if(numOfCommands > 1)
+		{
+			int fastest = 0;
+			for(int j = 1; j < numOfCommands; j++)
+			{
+				if(results[j].median < results[fastest].median)
+				{
+					fastest = j;
+				}
+			}
+
+			printf("fastest: %s\n", results[fastest].command);
+			for(int j = 0; j < numOfCommands; j++)
+			{
+				if(j != fastest)
+				{
+					printf("  %.3f times faster than %s (by median)\n",
+						results[j].median / results[fastest].median, results[j].command);
+				}
+			}
+			fflush(stdout);
+		}
+
+		if(csvFile != NULL)
+		{
+			writeBenchCsv(csvFile, results, numOfCommands);
+		}
+
+		if(jsonFile != NULL)
+		{
+			writeBenchJson(jsonFile, results, numOfCommands);
+		}
+	}
+
+	for(int j = 0; j < numOfCommands; j++)
+	{
+		free(results[j].wallTimes);
+		free(results[j].userTimes);
+		free(results[j].systemTimes);
+		free(results[j].maxResidentSizes);
+	}
+}
+
+/*
+ * Run one command numOfWarmups times untimed and then numOfRuns times timed, through spawnCommand() like
+ * executeCommand(). Each run is timed with CLOCK_MONOTONIC from just before fork() until wait4() returns,
+ * and wait4() supplies the run's resource usage. Fills in result and its statistics. Returns -1 if
+ * a run could not be spawned or was terminated by a signal, otherwise 0.
+ */
+int runBenchmark(struct benchResult *result, char **commandArgv, int numOfRuns, int numOfWarmups,
+					char *inputRedirection, char **outputRedirection, bool *appendOutput,
+					char **readBuffer, int **backgroundProcesses)
+{
+	/* Record the command as typed for reports. Input is limited to MAX_BUFFER_SIZE, so it always fits. */
+	for(int i = 0; commandArgv[i] != NULL; i++)
+	{
+		if(i > 0)
+		{
+			strcat(result->command, " ");
+		}
+		strcat(result->command, commandArgv[i]);
+	}
+
+	result->numOfRuns = numOfRuns;
+	result->wallTimes = calloc(numOfRuns, sizeof(double));
+	result->userTimes = calloc(numOfRuns, sizeof(double));
+	result->systemTimes = calloc(numOfRuns, sizeof(double));
+	result->maxResidentSizes = calloc(numOfRuns, sizeof(long));
+
+	if(result->wallTimes == NULL || result->userTimes == NULL || result->systemTimes == NULL
+		|| result->maxResidentSizes == NULL)
+	{
+		fprintf(stderr, "bench: cannot allocate memory for %d runs\n", numOfRuns);
+		fflush(stderr);
+		return -1;
+	}
+
+	/* Negative run numbers are warmups, which are run but not recorded. */
+	for(int run = -numOfWarmups; run < numOfRuns; run++)
+	{
+		struct timespec startTime;
+		struct timespec endTime;
+		struct rusage usage;
+		int childExitMethod;
+
+		/* The child reports through spawnPipe if it cannot run the command. The pipe is close-on-exec,
+		 * so once the child has exited it holds a byte only if the command never started. */
+		int spawnPipe[2];
+		if(pipe2(spawnPipe, O_CLOEXEC) == -1)
+		{
+			perror("bench: pipe error");
+			fflush(stderr);
+			return -1;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &startTime);
+
+		pid_t spawnPid = spawnCommand(commandArgv, inputRedirection, outputRedirection, appendOutput, false,
+							spawnPipe[1], readBuffer, backgroundProcesses);
+		if(spawnPid == -1)
+		{
+			close(spawnPipe[0]);
+			close(spawnPipe[1]);
+			return -1;
+		}
+
+		/* Wait until child process has finished -- while loop is necessary if wait4()
+		 * is interrupted by TSTP signal. */
+		while(wait4(spawnPid, &childExitMethod, 0, &usage) != spawnPid);
+
+		clock_gettime(CLOCK_MONOTONIC, &endTime);
+
+		/* Stop rather than time a command that could not be run. */
+		char spawnError;
+		close(spawnPipe[1]);
+		ssize_t spawnFailed = read(spawnPipe[0], &spawnError, 1);
+		close(spawnPipe[0]);
+
+		if(spawnFailed == 1)
+		{
+			fprintf(stderr, "bench: %s could not be run\n", commandArgv[0]);
+			fflush(stderr);
+			return -1;
+		}
+
+		if(WIFSIGNALED(childExitMethod) != 0)  //child terminated by signal: stop benchmarking
+		{
+			printf("terminated by signal %d\n", WTERMSIG(childExitMethod));
+			fflush(stdout);
+			return -1;
+		}
+
+		if(run >= 0)
+		{
+			result->wallTimes[run] = (endTime.tv_sec - startTime.tv_sec)
+										+ (endTime.tv_nsec - startTime.tv_nsec) / 1e9;
+			result->userTimes[run] = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+			result->systemTimes[run] = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+			result->maxResidentSizes[run] = usage.ru_maxrss;
+
+			if(WEXITSTATUS(childExitMethod) != 0)
+			{
+				result->numOfFailedRuns++;
+			}
+		}
+	}
+
+	/* Summary statistics are taken over the sorted wall times. */
+	double *sortedTimes = calloc(numOfRuns, sizeof(double));
+	if(sortedTimes == NULL)
+	{
+		fprintf(stderr, "bench: cannot allocate memory for %d runs\n", numOfRuns);
+		fflush(stderr);
+		return -1;
+	}
+	memcpy(sortedTimes, result->wallTimes, numOfRuns * sizeof(double));
+	qsort(sortedTimes, numOfRuns, sizeof(double), compareDoubles);
+
+	double sum = 0.0;
+	for(int i = 0; i < numOfRuns; i++)
+	{
+		sum += sortedTimes[i];
+		result->meanUser += result->userTimes[i] / numOfRuns;
+		result->meanSystem += result->systemTimes[i] / numOfRuns;
+	}
+	result->mean = sum / numOfRuns;
+
+	double squaredDeviations = 0.0;
+	for(int i = 0; i < numOfRuns; i++)
+	{
+		squaredDeviations += (sortedTimes[i] - result->mean) * (sortedTimes[i] - result->mean);
+	}
+	result->stddev = (numOfRuns > 1) ? sqrt(squaredDeviations / (numOfRuns - 1)) : 0.0;
+
+	result->min = sortedTimes[0];
+	result->max = sortedTimes[numOfRuns - 1];
+	result->median = percentile(sortedTimes, numOfRuns, 50);
+	result->p95 = percentile(sortedTimes, numOfRuns, 95);
+	result->p99 = percentile(sortedTimes, numOfRuns, 99);
+
+	/* Outliers are runs more than 1.5 interquartile ranges outside the quartiles. */
+	double q1 = percentile(sortedTimes, numOfRuns, 25);
+	double q3 = percentile(sortedTimes, numOfRuns, 75);
+	for(int i = 0; i < numOfRuns; i++)
+	{
+		if(sortedTimes[i] < q1 - 1.5 * (q3 - q1) || sortedTimes[i] > q3 + 1.5 * (q3 - q1))
+		{
+			result->numOfOutliers++;
+		}
+	}
+
+	free(sortedTimes);
+	return 0;
+}
+
+/*
+ * Parse a non-negative decimal count for a "bench" option into count. Returns false if text is not
+ * entirely a number or is out of range.
+ */
+bool parseCount(char *text, int *count)
+{
+	char *end;
+	errno = 0;
+	long value = strtol(text, &end, 10);
+
+	if(end == text || *end != '\0' || errno == ERANGE || value < 0 || value > INT_MAX)
+	{
+		return false;
+	}
+
+	*count = (int)value;
+	return true;
+}
+
+/*
+ * Return the p-th percentile of sortedValues, interpolating linearly between the closest ranks.
+ */
+double percentile(double *sortedValues, int numOfValues, double p)
+{
+	double rank = p / 100.0 * (numOfValues - 1);
+	int lower = (int)rank;
+
+	if(lower + 1 >= numOfValues)
+	{
+		return sortedValues[numOfValues - 1];
+	}
+
+	return sortedValues[lower] + (rank - lower) * (sortedValues[lower + 1] - sortedValues[lower]);
+}
+
+/*
+ * Comparison function for qsort() to sort doubles in ascending order.
+ */
+int compareDoubles(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Print the summary statistics of one benchmarked command.
+ */
+void printBenchResult(struct benchResult *result, int numOfWarmups)
+{
+	long maxResidentSize = 0;
+	for(int i = 0; i < result->numOfRuns; i++)
+	{
+		if(result->maxResidentSizes[i] > maxResidentSize)
+		{
+			maxResidentSize = result->maxResidentSizes[i];
+		}
+	}
+
+	printf("bench: %s\n", result->command);
+	printf("  runs %d, warmups %d, outliers %d\n", result->numOfRuns, numOfWarmups, result->numOfOutliers);
+	printf("  wall   mean %.6f s  stddev %.6f s\n", result->mean, result->stddev);
+	printf("         min %.6f s  median %.6f s  p95 %.6f s  p99 %.6f s  max %.6f s\n",
+		result->min, result->median, result->p95, result->p99, result->max);
+	printf("  mean user %.6f s  system %.6f s  max rss %ld KB\n",
+		result->meanUser, result->meanSystem, maxResidentSize);
+
+	if(result->numOfFailedRuns > 0)
+	{
+		printf("  warning: %d runs exited with a non-zero exit value\n", result->numOfFailedRuns);
+	}
+	fflush(stdout);
+}
+
+/*
+ * Write one CSV row of summary statistics per command to the named file. Times are in seconds.
+ */
+void writeBenchCsv(char *fileName, struct benchResult *results, int numOfCommands)
+{
+	FILE *file = fopen(fileName, "w");
+
+	if(file == NULL)
+	{
+		fprintf(stderr, "cannot open %s for output\n", fileName);
+		fflush(stderr);
+		return;
+	}
+
+	fprintf(file, "command,runs,mean,stddev,min,median,p95,p99,max,user,system,outliers\n");
+	for(int i = 0; i < numOfCommands; i++)
+	{
+		/* Quote the command, doubling any quotes inside it. */
+		fputc('"', file);
+		for(char *c = results[i].command; *c != '\0'; c++)
+		{
+			if(*c == '"')
+			{
+				fputc('"', file);
+			}
+			fputc(*c, file);
+		}
+		fputc('"', file);
+
+		fprintf(file, ",%d,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%d\n", results[i].numOfRuns,
+			results[i].mean, results[i].stddev, results[i].min, results[i].median, results[i].p95,
+			results[i].p99, results[i].max, results[i].meanUser, results[i].meanSystem,
+			results[i].numOfOutliers);
+	}
+
+	fclose(file);
+}
+
+/*
+ * Write the summary statistics and the measurements of every run to the named file as JSON.
+ * Times are in seconds and max rss in KB.
+ */
+void writeBenchJson(char *fileName, struct benchResult *results, int numOfCommands)
+{
+	FILE *file = fopen(fileName, "w");
+
+	if(file == NULL)
+	{
+		fprintf(stderr, "cannot open %s for output\n", fileName);
+		fflush(stderr);
+		return;
+	}
+
+	fprintf(file, "{\n  \"results\": [\n");
+	for(int i = 0; i < numOfCommands; i++)
+	{
+		struct benchResult *result = &results[i];
+
+		/* Escape quotes, backslashes and control characters in the command. */
+		fprintf(file, "    {\n      \"command\": \"");
+		for(char *c = result->command; *c != '\0'; c++)
+		{
+			if(*c == '"' || *c == '\\')
+			{
+				fprintf(file, "\\%c", *c);
+			}
+			else if((unsigned char)*c < 0x20)
+			{
+				fprintf(file, "\\u%04x", *c);
+			}
+			else
+			{
+				fputc(*c, file);
+			}
+		}
+		fprintf(file, "\",\n");
+
+		fprintf(file, "      \"runs\": %d,\n      \"mean\": %.9f,\n      \"stddev\": %.9f,\n"
+			"      \"min\": %.9f,\n      \"median\": %.9f,\n      \"p95\": %.9f,\n      \"p99\": %.9f,\n"
+			"      \"max\": %.9f,\n      \"user\": %.9f,\n      \"system\": %.9f,\n      \"outliers\": %d,\n"
+			"      \"failed_runs\": %d,\n", result->numOfRuns, result->mean, result->stddev, result->min,
+			result->median, result->p95, result->p99, result->max, result->meanUser, result->meanSystem,
+			result->numOfOutliers, result->numOfFailedRuns);
+
+		/* Per-run measurements, in run order. */
+		fprintf(file, "      \"times\": [");
+		for(int j = 0; j < result->numOfRuns; j++)
+		{
+			fprintf(file, "%s%.9f", (j > 0) ? ", " : "", result->wallTimes[j]);
+		}
+		fprintf(file, "],\n      \"user_times\": [");
+		for(int j = 0; j < result->numOfRuns; j++)
+		{
+			fprintf(file, "%s%.9f", (j > 0) ? ", " : "", result->userTimes[j]);
+		}
+		fprintf(file, "],\n      \"system_times\": [");
+		for(int j = 0; j < result->numOfRuns; j++)
+		{
+			fprintf(file, "%s%.9f", (j > 0) ? ", " : "", result->systemTimes[j]);
+		}
+		fprintf(file, "],\n      \"max_rss_kb\": [");
+		for(int j = 0; j < result->numOfRuns; j++)
+		{
+			fprintf(file, "%s%ld", (j > 0) ? ", " : "", result->maxResidentSizes[j]);
+		}
+		fprintf(file, "]\n    }%s\n", (i < numOfCommands - 1) ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+
+	fclose(file);
+}
+
+/*
+ * Execute the command requested by user. Fork off new child, perform any necessary redirection,
+ * and call execvp() function. If run in background is requested, then command line control is
+ * given directly back to user; otherwise, the process will run in foreground and shell will wait
+ * until process finishes execution before returning commmand line control to user.
+ */
+void executeCommand(char **argv, char *inputRedirection, char **outputRedirection, bool *appendOutput,
+					bool runInBackground,
+					int *exitMethod, int **backgroundProcesses, int *backgroundIndex, 
+					int *sizeOfBackgroundArray, char **readBuffer, int *exitStatus)
+{
+	pid_t spawnPid;
+	int childExitMethod;
+
+	/* Fork new child and execute the command in it. spawnCommand() prints a message if fork() fails. */
+	spawnPid = spawnCommand(argv, inputRedirection, outputRedirection, appendOutput, runInBackground, -1,
+					readBuffer, backgroundProcesses);
+
+	if(spawnPid != -1)  //in parent process
+	{
+		/* If child process is running in foregrond (i.e. runInBackground flag is not set, or
+		 * bgOn is not set, that is, foreground-only mode is ON), then wait for process
+		 * to terminated. Determine if the child exited normarlly or was terminated by signal
+		 * and extract and save the exit status. Print out message if child process was terminated
+		 * by a signal. */
+		if(!runInBackground || !bgOn)
+		{
+			/* Wait until child process has finished -- while loop is necessary if waitpid()
+			 * is interrupted by TSTP signal. */
+			int receivedPid = 0;
+			while((receivedPid = waitpid(spawnPid, &childExitMethod, 0)) != spawnPid);
+
+			if(WIFEXITED(childExitMethod) != 0)  //child exited normally
+			{
+				*exitStatus = WEXITSTATUS(childExitMethod);  //extract exit status
+				*exitMethod = 0;  //set exitMethod to 0, indicating normal exit
+			}
+			else if(WIFSIGNALED(childExitMethod) != 0)  //child terminated by signal
+			{
+				*exitStatus = WTERMSIG(childExitMethod);  //extract signal that terminated process
+				*exitMethod = 1;  //set exitMethod to 1, indicating terminated by signal
+
+				printf("terminated by signal %d\n", *exitStatus);
+				fflush(stdout);
+			}
+		}
+		/* Else, child process is running in background. Print child pid to screen and add
+		 * pid to backgroundProcesses array.  */
+		else
+		{
+			printf("background pid is %d\n", spawnPid);
+			fflush(stdout);
+
+			addBackgroundProcess(spawnPid, backgroundProcesses, backgroundIndex, sizeOfBackgroundArray,
+				argv, readBuffer);
+		}
+	}
+}
+
+/*
+ * Fork off new child, perform any necessary redirection and signal setup in it, and call execvp() function.
+ * Returns the child pid to the parent without waiting, or -1 if fork() fails. If spawnErrorFD is not -1,
+ * the child writes a byte to it when it fails before or in execvp(), so the caller can tell a command
+ * that could not be run from one that ran and failed.
+ */
+pid_t spawnCommand(char **argv, char *inputRedirection, char **outputRedirection, bool *appendOutput,
+					bool runInBackground, int spawnErrorFD, char **readBuffer, int **backgroundProcesses)
+{
+	pid_t spawnPid = fork();  //fork new child
+
+	if(spawnPid == -1)  //if fork() fails
+	{
+		perror("Bad spawn");
+		fflush(stderr);
+	}
+	else if(spawnPid == 0)  //in child process
+	{
+		/* If process will run in background but inputRedirection is not assigned, then
+		 * assign "/dev/null" to inputRedirection. */
+		if(runInBackground && inputRedirection == NULL)
+		{
+			inputRedirection = "/dev/null";
+		}
+
+		/* If process will run in background but outputRedirection is not assigned, then
+		 * assign "/dev/null" to outRedirection. */
+		if(runInBackground && outputRedirection[0] == NULL)
+		{
+			outputRedirection[0] = "/dev/null";
+		}
+
+		/* If inputRedirection is assigned something, then open up the file pointed by
+		 * inputRedirection and use dup2() to assign stdin to point to the file. */
+		if(inputRedirection != NULL)
+		{
+			int sourceFD;  //will hold file descriptor for opened file
+			sourceFD = open(inputRedirection, O_RDONLY);  //open file for read-only
+
+			if(sourceFD == -1)  //if error opening file, print message, free mem, and exit
+			{
+				fprintf(stderr, "cannot open %s for input\n", inputRedirection);
+				fflush(stderr);
+
+				reportSpawnFailure(spawnErrorFD);
+				freeAll(argv, readBuffer, backgroundProcesses);  //needed to prevent mem leaks
+				exit(1);
+			}
+
+			int result = dup2(sourceFD, 0);  //assign stdin to point to sourceFD
+			if(result == -1)  //if error in dup() operation, print message, free mem, and exit
+			{
+				perror("Source dup2() error");
+				fflush(stderr);
+
+				reportSpawnFailure(spawnErrorFD);
+				freeAll(argv, readBuffer, backgroundProcesses);  //needed to prevent mem leaks
+				exit(1);
+			}
+		}
+
+		/* Open every file in the outputRedirection array. Several files are written with splice(). */
+		int targetFDs[MAX_NUM_OF_OUTPUT];  //will hold file descriptors for opened files
+		int numOfTargets = 0;
+		while(outputRedirection[numOfTargets] != NULL)
+		{
+			numOfTargets++;
+		}
+
+		for(int i = 0; i < numOfTargets; i++)
+		{
+			targetFDs[i] = openOutputRedirection(outputRedirection[i], appendOutput[i], numOfTargets > 1);
+
+			if(targetFDs[i] == -1)  //if error opening file, print message, free mem, and exit
+			{
+				fprintf(stderr, "cannot open %s for output\n", outputRedirection[i]);
+				fflush(stderr);
+
+				reportSpawnFailure(spawnErrorFD);
+				freeAll(argv, readBuffer, backgroundProcesses);  //needed to prevent mem leaks
+				exit(1);
+			}
+		}
+
+		/* If there is a single output file, use dup2() to assign stdout to point to the file.
+		 * Several output files are handled by fanOutOutput() below. */
+		if(numOfTargets == 1)
+		{
+			int result = dup2(targetFDs[0], 1);  //assign stdout to point to targetFD
+			if(result == -1)  //if error in dup() operation, print message, free mem, and exit
+			{
+				perror("Target dup2() error");
+				fflush(stderr);
+
+				reportSpawnFailure(spawnErrorFD);
+				freeAll(argv, readBuffer, backgroundProcesses);  //needed to prevent mem leaks
+				exit(1);
+			}
+		}
+
+		/* Create signal handlers for child process */
+		struct sigaction ignore_action = {{0}};
+		struct sigaction default_action = {{0}};
+
+		/* Struct sigaction to ignore signal */
+		ignore_action.sa_handler = SIG_IGN;
+		sigfillset(&ignore_action.sa_mask);
+		ignore_action.sa_flags = 0;
+
+		/* Struct sigaction to take default action */
+		default_action.sa_handler = SIG_DFL;
+		sigfillset(&default_action.sa_mask);
+		default_action.sa_flags = 0;
+
+		/* Register child processes to ignore SIGTSTP and restore default SIGPIPE
+		 * (ignored signals would otherwise carry over through execvp()) */
+		sigaction(SIGTSTP, &ignore_action, NULL);
+		sigaction(SIGPIPE, &default_action, NULL);
+
+		/* If child process is to run in background (i.e. runInBackground flag is set
+		 * AND bgOn flag is set to enable background processes), then register the
+		 * child process to ignore the SIGINT. */
+		if(runInBackground && bgOn)
+		{
+			sigaction(SIGINT, &ignore_action, NULL);
+		}
+		/* Else, child will run in foreground. Register child process
+		 * to take default action on receipt of SIGINT. */
+		else
+		{
+			sigaction(SIGINT, &default_action, NULL);
+		}
+
+		/* If there are several output files, assign stdout to a pipe that is fanned out to every file.
+		 * Only the command's own process returns from fanOutOutput(). */
+		if(numOfTargets > 1)
+		{
+			fanOutOutput(targetFDs, outputRedirection, numOfTargets, argv, readBuffer, backgroundProcesses);
+		}
+
+		/* Execute the command in argv[0] and pass argv. */
+		execvp(argv[0], argv);
+
+		/* The following section will only execute if execvp returns an error. */
+		fprintf(stderr, "%s: no such file or directory\n", argv[0]);
+		fflush(stderr);
+
+		reportSpawnFailure(spawnErrorFD);
+		freeAll(argv, readBuffer, backgroundProcesses);  //needed to prevent mem leaks
+		exit(1);
+	}
+
+	return spawnPid;
+}
+
+/*
+ * Called by a child about to exit because it could not run its command. Writes a byte to spawnErrorFD
+ * (if not -1) to tell the parent.
+ */
+void reportSpawnFailure(int spawnErrorFD)
+{
+	if(spawnErrorFD != -1)
+	{
+		write(spawnErrorFD, "!", 1);
+	}
+}
+
+/*
+ * Open an output redirection file and return its file descriptor, or -1 on error. If the file will be
+ * written with splice() (forSplice), ">>" seeks to the end instead of using O_APPEND, because splice()
+ * refuses files opened with O_APPEND.
+ */
+int openOutputRedirection(char *outputRedirection, bool appendOutput, bool forSplice)
+{
+	/* If opening "/dev/null", then open for write-only. Otherwise, in addition
+	 * to opening file for write-only, if non-existent, then create the file, and
+	 * if file already exist, truncate the file (or append to it for ">>"). */
+	if(strcmp(outputRedirection, "/dev/null") == 0)
+	{
+		return open("/dev/null", O_WRONLY);
+	}
+
+	/* Opened file permission set to 644: user(RW-), group(R--), and others(R--). */
+	int flags = O_WRONLY | O_CREAT | (appendOutput ? (forSplice ? 0 : O_APPEND) : O_TRUNC);
+	int targetFD = open(outputRedirection, flags, 0644);
+
+	if(targetFD != -1 && appendOutput && forSplice && lseek(targetFD, 0, SEEK_END) == -1
+		&& errno != ESPIPE)  //files that cannot seek (e.g. a FIFO) are already written at the end
+	{
+		close(targetFD);
+		return -1;
+	}
+
+	return targetFD;
+}
+
+/*
+ * Fan the command's stdout out to several output files. Forks again: the new child returns to execvp()
+ * with stdout assigned to a pipe, while this process moves the pipe's contents into every file with
+ * fanOutPipe(). Once the command exits, this process exits with the same exit status (or is terminated
+ * by the same signal), so the shell reports the command's status as usual.
+ */
+void fanOutOutput(int *targetFDs, char **outputRedirection, int numOfTargets, char **argv, char **readBuffer,
+					int **backgroundProcesses)
+{
+	int outputPipe[2];  //command writes to outputPipe[1], fan-out process reads from outputPipe[0]
+
+	if(pipe(outputPipe) == -1)
+	{
+		perror("Output pipe error");
+		fflush(stderr);
+
+		freeAll(argv, readBuffer, backgroundProcesses);  //needed to prevent mem leaks
+		exit(1);
+	}
+
+	/* A larger pipe lets each round move more data per system call; keep the default size if refused. */
+	fcntl(outputPipe[0], F_SETPIPE_SZ, FAN_OUT_PIPE_SIZE);
+
+	pid_t spawnPid = fork();  //fork the process that will run the command
+
+	if(spawnPid == -1)  //if fork() fails
+	{
+		perror("Bad spawn");
+		fflush(stderr);
+
+		freeAll(argv, readBuffer, backgroundProcesses);  //needed to prevent mem leaks
+		exit(1);
+	}
+	else if(spawnPid == 0)  //in command process: assign stdout to the pipe and return to execvp()
+	{
+		if(dup2(outputPipe[1], 1) == -1)
+		{
+			perror("Target dup2() error");
+			fflush(stderr);
+
+			freeAll(argv, readBuffer, backgroundProcesses);  //needed to prevent mem leaks
+			exit(1);
+		}
+
+		close(outputPipe[0]);
+		close(outputPipe[1]);
+		for(int i = 0; i < numOfTargets; i++)
+		{
+			close(targetFDs[i]);
+		}
+
+		return;
+	}
+
+	/* In fan-out process. Close the write end so the pipe reaches end-of-file when the command exits. */
+	close(outputPipe[1]);
+
+	/* This process never calls execvp(), so close-on-exec does not apply to it. Close everything else
+	 * it inherited, such as the shell's ends of coprocess pipes, so it does not hold them open. */
+	closeOtherDescriptors(outputPipe[0], targetFDs, numOfTargets);
+
+	if(fanOutPipe(outputPipe[0], targetFDs, outputRedirection, numOfTargets) == -1)
+	{
+		perror("Output fan-out error");
+		fflush(stderr);
+	}
+
+	close(outputPipe[0]);
+	for(int i = 0; i < numOfTargets; i++)
+	{
+		close(targetFDs[i]);
+	}
+
+	/* Wait for the command and pass its exit status on to the shell. */
+	int childExitMethod;
+	while(waitpid(spawnPid, &childExitMethod, 0) != spawnPid);
+
+	freeAll(argv, readBuffer, backgroundProcesses);  //needed to prevent mem leaks
+
+	if(WIFSIGNALED(childExitMethod) != 0)  //command terminated by signal: terminate by the same signal
+	{
+		signal(WTERMSIG(childExitMethod), SIG_DFL);
+		raise(WTERMSIG(childExitMethod));
+	}
+
+	exit(WIFEXITED(childExitMethod) ? WEXITSTATUS(childExitMethod) : 1);
+}
+
+/*
+ * Close every file descriptor above stderr except sourceFD and the ones in targetFDs. The open
+ * descriptors are listed from /proc/self/fd; if that is unavailable, every possible descriptor is tried.
+ */
+void closeOtherDescriptors(int sourceFD, int *targetFDs, int numOfTargets)
+{
+	DIR *fdDir = opendir("/proc/self/fd");
+
+	if(fdDir != NULL)
+	{
+		struct dirent *entry;
+		while((entry = readdir(fdDir)) != NULL)
+		{
+			int fd = atoi(entry->d_name);  //"." and ".." give 0, which is kept
+
+			if(fd > 2 && fd != dirfd(fdDir) && !isFanOutDescriptor(fd, sourceFD, targetFDs, numOfTargets))
+			{
+				close(fd);
+			}
+		}
+
+		closedir(fdDir);
+	}
+	else
+	{
+		long maxFD = sysconf(_SC_OPEN_MAX);
+		for(int fd = 3; fd < maxFD; fd++)
+		{
+			if(!isFanOutDescriptor(fd, sourceFD, targetFDs, numOfTargets))
+			{
+				close(fd);
+			}
+		}
+	}
+}
+
+/*
+ * Return true if fd is sourceFD or one of the descriptors in targetFDs.
+ */
+bool isFanOutDescriptor(int fd, int sourceFD, int *targetFDs, int numOfTargets)
+{
+	if(fd == sourceFD)
+	{
+		return true;
+	}
+
+	for(int i = 0; i < numOfTargets; i++)
+	{
+		if(fd == targetFDs[i])
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Copy everything read from the pipe sourceFD into every file in targetFDs (at least two) until
+ * end-of-file, without the data entering user space. The files are fed by a chain of pipes: each
+ * round, a chunk is duplicated from one pipe into the next with tee() and then moved from the first
+ * pipe into its file with splice(); the last pipe in the chain is moved into the last file.
+ * Returns 0 on end-of-file or -1 on error.
+ */
+int fanOutPipe(int sourceFD, int *targetFDs, char **outputRedirection, int numOfTargets)
+{
+	int numOfTeePipes = numOfTargets - 1;
+	int teePipes[MAX_NUM_OF_OUTPUT][2];
+	bool copying[MAX_NUM_OF_OUTPUT] = {false};  //set once a file has fallen back to copying through a buffer
+	int result = 0;
+
+	for(int i = 0; i < numOfTeePipes; i++)
+	{
+		if(pipe(teePipes[i]) == -1)
+		{
+			for(int j = 0; j < i; j++)
+			{
+				close(teePipes[j][0]);
+				close(teePipes[j][1]);
+			}
+			return -1;
+		}
+
+		/* Ask for a larger pipe; the request may be refused (e.g. over the user's pipe page limit). */
+		fcntl(teePipes[i][1], F_SETPIPE_SZ, FAN_OUT_PIPE_SIZE);
+	}
+
+	/* A middle file's tee pipe is not drained until the round ends, so it must hold a whole chunk.
+	 * Shrink every tee pipe to the smallest capacity actually granted, and never duplicate more than
+	 * that per round. */
+	int chunkLimit = fcntl(sourceFD, F_GETPIPE_SZ);
+	for(int i = 0; i < numOfTeePipes; i++)
+	{
+		int capacity = fcntl(teePipes[i][1], F_GETPIPE_SZ);
+		if(capacity > 0 && (chunkLimit <= 0 || capacity < chunkLimit))
+		{
+			chunkLimit = capacity;
+		}
+	}
+
+	for(int i = 0; i < numOfTeePipes && chunkLimit > 0; i++)
+	{
+		if(fcntl(teePipes[i][1], F_SETPIPE_SZ, chunkLimit) == -1)
+		{
+			result = -1;
+		}
+	}
+
+	if(chunkLimit <= 0 || result == -1)
+	{
+		for(int i = 0; i < numOfTeePipes; i++)
+		{
+			close(teePipes[i][0]);
+			close(teePipes[i][1]);
+		}
+		return -1;
+	}
+
+	while(true)
+	{
+		/* Wait for output from the command and duplicate up to one chunk into the first tee pipe.
+		 * The number of bytes duplicated is the chunk every file receives this round. */
+		ssize_t chunk = tee(sourceFD, teePipes[0][1], chunkLimit, 0);
+
+		if(chunk == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		else if(chunk <= 0)  //0 on end-of-file, -1 on error
+		{
+			result = (int)chunk;
+			break;
+		}
+
+		/* First file: move the chunk out of the source pipe. */
+		result = spliceAll(sourceFD, targetFDs[0], chunk, outputRedirection[0], &copying[0]);
+
+		/* Middle files: duplicate the chunk into the next tee pipe, then move it into the file. */
+		for(int i = 1; i < numOfTeePipes && result == 0; i++)
+		{
+			ssize_t copied = 0;
+			while(copied < chunk && result == 0)
+			{
+				ssize_t teed = tee(teePipes[i - 1][0], teePipes[i][1], chunk - copied, 0);
+
+				if(teed == -1 && errno == EINTR)
+				{
+					continue;
+				}
+				else if(teed <= 0)
+				{
+					result = -1;
+				}
+				else
+				{
+					result = spliceAll(teePipes[i - 1][0], targetFDs[i], teed, outputRedirection[i], &copying[i]);
+					copied += teed;
+				}
+			}
+		}
+
+		/* Last file: move the chunk out of the last tee pipe. */
+		if(result == 0)
+		{
+			result = spliceAll(teePipes[numOfTeePipes - 1][0], targetFDs[numOfTargets - 1], chunk,
+						outputRedirection[numOfTargets - 1], &copying[numOfTargets - 1]);
+		}
+
+		if(result == -1)
+		{
+			break;
+		}
+	}
+
+	for(int i = 0; i < numOfTeePipes; i++)
+	{
+		close(teePipes[i][0]);
+		close(teePipes[i][1]);
+	}
+
+	return result;
+}
+
+/*
+ * Move exactly length bytes from the pipe sourceFD into targetFD with splice(). If the target does not
+ * support splice() (splice() fails with EINVAL), a warning naming targetName is printed the first time,
+ * *copying is set, and the bytes are copied through a buffer from then on. Returns 0 on success or -1
+ * on error.
+ */
+int spliceAll(int sourceFD, int targetFD, size_t length, char *targetName, bool *copying)
+{
+	while(length > 0)
+	{
+		ssize_t moved = -1;
+
+		if(!*copying)
+		{
+			moved = splice(sourceFD, NULL, targetFD, NULL, length, SPLICE_F_MOVE);
+
+			if(moved == -1 && errno == EINVAL)
+			{
+				fprintf(stderr, "warning: %s does not support splice(), copying output through a buffer\n",
+					targetName);
+				fflush(stderr);
+				*copying = true;
+			}
+		}
+
+		if(*copying)  //fall back to read() and write()
+		{
+			char buffer[FAN_OUT_BUFFER_SIZE];
+			moved = read(sourceFD, buffer, (length < sizeof(buffer)) ? length : sizeof(buffer));
+
+			for(ssize_t written = 0; moved > 0 && written < moved; )
+			{
+				ssize_t result = write(targetFD, buffer + written, moved - written);
+
+				if(result == -1 && errno != EINTR)
+				{
+					return -1;
+				}
+				else if(result > 0)
+				{
+					written += result;
+				}
+			}
+		}
+
+		if(moved == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		else if(moved <= 0)
+		{
+			return -1;
+		}
+
+		length -= moved;
+	}
+
+	return 0;
+}
+
+/*
+ * Add a child pid to the backgroundProcesses array so it will be reaped (and killed on exit).
+ * The array doubles in size when it is at capacity.
+ */
+void addBackgroundProcess(pid_t spawnPid, int **backgroundProcesses, int *backgroundIndex,
+					int *sizeOfBackgroundArray, char **argv, char **readBuffer)
+{
+	/* If backgroundProcesses is at capacity, double the allocated memory size. */
+	if(*backgroundIndex == *sizeOfBackgroundArray)
+	{
+		(*sizeOfBackgroundArray) *= 2;  //double array size
+		*backgroundProcesses = realloc(*backgroundProcesses, *sizeOfBackgroundArray * sizeof(int));
+
+		if(*backgroundProcesses == NULL)  //display message if error encountered in realloc
+		{
+			perror("Error in expanding background array\n");
+			fflush(stderr);
+
+			freeAll(argv, readBuffer, backgroundProcesses);
+			exit(1);
+		}
+	}
+
+	(*backgroundProcesses)[*backgroundIndex] = spawnPid;  //add child pid to backgroundProcesses array
+	(*backgroundIndex)++;  //increment backgroundIndex
 }
 
 /*